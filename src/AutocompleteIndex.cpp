@@ -0,0 +1,509 @@
+// AutocompleteIndex.cpp
+// Implementation of AutocompleteIndex class
+// Every node of the prefix tree keeps its own short list of the most popular
+// completions, so a suggestion is a walk down the typed prefix and a copy.
+// The lists are kept exact on every change, queries never rebuild anything.
+
+#include "AutocompleteIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+const int AutocompleteIndex::TOP_SIZE;
+
+// Constructor - start with just the root node
+AutocompleteIndex::AutocompleteIndex() : nodes(1) {
+    nodes[0].firstChild = -1;
+    nodes[0].nextSibling = -1;
+    nodes[0].word = -1;
+    nodes[0].top.size = 0;
+    nodes[0].letter = 0;
+}
+
+// Titles and authors with the same text are different terms
+std::string AutocompleteIndex::makeKey(Kind kind, const std::string& text) {
+    return std::string(1, static_cast<char>('0' + kind)) + text;
+}
+
+// Split into lowercase words, ignoring punctuation and repeated words
+std::vector<std::string> AutocompleteIndex::tokenize(const std::string& text) {
+    std::vector<std::string> tokens;
+    std::string current;
+
+    for (size_t i = 0; i <= text.size(); i++) {
+        unsigned char c = (i < text.size()) ? text[i] : ' ';
+        if (std::isalnum(c)) {
+            current += static_cast<char>(std::tolower(c));
+        } else if (!current.empty()) {
+            if (std::find(tokens.begin(), tokens.end(), current) == tokens.end()) {
+                tokens.push_back(current);
+            }
+            current.clear();
+        }
+    }
+    return tokens;
+}
+
+// Ordering of suggestions - most borrowed first, then alphabetical
+bool AutocompleteIndex::ranksAbove(int a, int b) const {
+    if (terms[a].popularity != terms[b].popularity) {
+        return terms[a].popularity > terms[b].popularity;
+    }
+    if (terms[a].text != terms[b].text) {
+        return terms[a].text < terms[b].text;
+    }
+    return terms[a].kind < terms[b].kind;
+}
+
+// Walk the sibling chain, which is sorted by letter, -1 if there is no such child
+int AutocompleteIndex::findChild(int node, char c) const {
+    int child = nodes[node].firstChild;
+    while (child != -1 && nodes[child].letter < c) {
+        child = nodes[child].nextSibling;
+    }
+    return (child != -1 && nodes[child].letter == c) ? child : -1;
+}
+
+// Node reached by a whole prefix, -1 if nothing starts with it
+int AutocompleteIndex::findNode(const std::string& prefix) const {
+    int node = 0;
+    for (size_t i = 0; i < prefix.size() && node != -1; i++) {
+        node = findChild(node, prefix[i]);
+    }
+    return node;
+}
+
+// Nodes for every prefix of a word, root excluded
+// Missing nodes are created when asked to, otherwise the path just stops short
+void AutocompleteIndex::collectPath(const std::string& token, bool create, std::vector<int>& path) {
+    int node = 0;
+    for (size_t i = 0; i < token.size(); i++) {
+        int previous = -1;
+        int child = nodes[node].firstChild;
+        while (child != -1 && nodes[child].letter < token[i]) {
+            previous = child;
+            child = nodes[child].nextSibling;
+        }
+
+        if (child == -1 || nodes[child].letter != token[i]) {
+            if (!create) {
+                return;
+            }
+            Node fresh;
+            fresh.firstChild = -1;
+            fresh.nextSibling = child;
+            fresh.word = -1;
+            fresh.top.size = 0;
+            fresh.letter = token[i];
+
+            child = nodes.size();
+            nodes.push_back(fresh);
+            if (previous == -1) {
+                nodes[node].firstChild = child;
+            } else {
+                nodes[previous].nextSibling = child;
+            }
+        }
+        path.push_back(child);
+        node = child;
+    }
+}
+
+// Let a term compete for a place in a list
+// Popularity only ever grows while a term exists, so a full list stays correct
+void AutocompleteIndex::offer(TopList& list, int term) const {
+    if (terms[term].books == 0) {
+        return;  // being removed
+    }
+
+    int position = std::find(list.ids, list.ids + list.size, term) - list.ids;
+    if (position == list.size) {
+        if (list.size < TOP_SIZE) {
+            list.ids[list.size++] = term;
+        } else if (ranksAbove(term, list.ids[TOP_SIZE - 1])) {
+            position = TOP_SIZE - 1;
+            list.ids[position] = term;
+        } else {
+            return;
+        }
+    }
+
+    // Move up past anything it now beats
+    while (position > 0 && ranksAbove(list.ids[position], list.ids[position - 1])) {
+        std::swap(list.ids[position], list.ids[position - 1]);
+        position--;
+    }
+}
+
+// Take a term out of a list, true if it was there
+bool AutocompleteIndex::removeFrom(TopList& list, int term) {
+    int* slot = std::find(list.ids, list.ids + list.size, term);
+    if (slot == list.ids + list.size) {
+        return false;
+    }
+    std::copy(slot + 1, list.ids + list.size, slot);
+    list.size--;
+    return true;
+}
+
+// Refill a word's list from all terms containing it
+// Only happens when one of its best terms is removed while the list was full
+void AutocompleteIndex::repairWord(Word& word) const {
+    word.top.size = 0;
+    for (int id : word.endings) {
+        offer(word.top, id);
+    }
+}
+
+// Refill a node's list from the lists right below it - its own word and its children
+// Those are exact already, so the best terms below must be among them
+void AutocompleteIndex::repairNode(int node) {
+    TopList repaired;
+    repaired.size = 0;
+
+    if (nodes[node].word != -1) {
+        const TopList& own = words[nodes[node].word].top;
+        for (int i = 0; i < own.size; i++) {
+            offer(repaired, own.ids[i]);
+        }
+    }
+    for (int child = nodes[node].firstChild; child != -1; child = nodes[child].nextSibling) {
+        for (int i = 0; i < nodes[child].top.size; i++) {
+            offer(repaired, nodes[child].top.ids[i]);
+        }
+    }
+    nodes[node].top = repaired;
+}
+
+// Register a title or author - books sharing it just bump the count
+void AutocompleteIndex::addTerm(Kind kind, const std::string& text) {
+    std::string key = makeKey(kind, text);
+    std::unordered_map<std::string, int>::iterator found = termIds.find(key);
+    if (found != termIds.end()) {
+        terms[found->second].books++;
+        return;
+    }
+
+    int id;
+    if (!freeTerms.empty()) {
+        id = freeTerms.back();
+        freeTerms.pop_back();
+    } else {
+        id = terms.size();
+        terms.push_back(Term());
+    }
+
+    Term& term = terms[id];
+    term.text = text;
+    term.kind = kind;
+    term.books = 1;
+    term.popularity = 0;
+    termIds[key] = id;
+
+    // Words are not stored per term, tokenize() gives them back in the same order
+    std::vector<std::string> tokens = tokenize(text);
+    term.words.resize(tokens.size());
+    for (size_t i = 0; i < tokens.size(); i++) {
+        std::vector<int> path;
+        collectPath(tokens[i], true, path);
+
+        int end = path.back();
+        if (nodes[end].word == -1) {
+            nodes[end].word = words.size();
+            words.push_back(Word());
+            words.back().top.size = 0;
+        }
+
+        Word& word = words[nodes[end].word];
+        term.words[i] = std::make_pair(nodes[end].word, static_cast<int>(word.endings.size()));
+        word.endings.push_back(id);
+        offer(word.top, id);
+
+        for (int node : path) {
+            offer(nodes[node].top, id);
+        }
+    }
+}
+
+// Drop a term once its last book is gone
+// Nodes and words are kept so a re-added word doesn't allocate again
+void AutocompleteIndex::removeTerm(Kind kind, const std::string& text) {
+    std::unordered_map<std::string, int>::iterator found = termIds.find(makeKey(kind, text));
+    if (found == termIds.end()) {
+        return;
+    }
+
+    int id = found->second;
+    Term& term = terms[id];
+    if (--term.books > 0) {
+        return;
+    }
+    // From here on offer() ignores the term, so repairs can't bring it back
+
+    std::vector<std::string> tokens = tokenize(text);
+    std::vector<std::pair<int, int> > affected;  // (depth, node) of every prefix
+    for (size_t i = 0; i < tokens.size(); i++) {
+        Word& word = words[term.words[i].first];
+        int slot = term.words[i].second;
+
+        // Swap the last ending into our slot and tell its term where it went
+        int last = word.endings.back();
+        word.endings[slot] = last;
+        word.endings.pop_back();
+        if (last != id) {
+            for (std::pair<int, int>& entry : terms[last].words) {
+                if (entry.first == term.words[i].first) {
+                    entry.second = slot;
+                }
+            }
+        }
+
+        bool wasFull = (word.top.size == TOP_SIZE);
+        if (removeFrom(word.top, id) && wasFull) {
+            repairWord(word);
+        }
+
+        std::vector<int> path;
+        collectPath(tokens[i], false, path);
+        for (size_t depth = 0; depth < path.size(); depth++) {
+            affected.push_back(std::make_pair(static_cast<int>(depth), path[depth]));
+        }
+    }
+
+    // Deepest nodes first, so every repair reads finished lists below it
+    // A list that wasn't full held everything below it and needs no repair
+    std::sort(affected.begin(), affected.end(), std::greater<std::pair<int, int> >());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+    for (const std::pair<int, int>& entry : affected) {
+        TopList& top = nodes[entry.second].top;
+        bool wasFull = (top.size == TOP_SIZE);
+        if (removeFrom(top, id) && wasFull) {
+            repairNode(entry.second);
+        }
+    }
+
+    termIds.erase(found);
+    term.text.clear();
+    term.words.clear();
+    freeTerms.push_back(id);
+}
+
+// One more borrow - re-offer the term to its words and along their paths
+void AutocompleteIndex::bumpTerm(Kind kind, const std::string& text) {
+    std::unordered_map<std::string, int>::iterator found = termIds.find(makeKey(kind, text));
+    if (found == termIds.end()) {
+        return;
+    }
+
+    int id = found->second;
+    terms[id].popularity++;
+    std::vector<std::string> tokens = tokenize(text);
+    for (size_t i = 0; i < tokens.size(); i++) {
+        offer(words[terms[id].words[i].first].top, id);
+
+        std::vector<int> path;
+        collectPath(tokens[i], false, path);
+        for (int node : path) {
+            offer(nodes[node].top, id);
+        }
+    }
+}
+
+void AutocompleteIndex::addBook(const Book& book) {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    addTerm(TITLE, book.getTitle());
+    addTerm(AUTHOR, book.getAuthor());
+}
+
+void AutocompleteIndex::removeBook(const Book& book) {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    removeTerm(TITLE, book.getTitle());
+    removeTerm(AUTHOR, book.getAuthor());
+}
+
+// Only a changed title or author is re-registered, the renamed one starts unborrowed
+void AutocompleteIndex::updateBook(const Book& before, const Book& after) {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    if (before.getTitle() != after.getTitle()) {
+        removeTerm(TITLE, before.getTitle());
+        addTerm(TITLE, after.getTitle());
+    }
+    if (before.getAuthor() != after.getAuthor()) {
+        removeTerm(AUTHOR, before.getAuthor());
+        addTerm(AUTHOR, after.getAuthor());
+    }
+}
+
+void AutocompleteIndex::recordBorrow(const Book& book) {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    bumpTerm(TITLE, book.getTitle());
+    bumpTerm(AUTHOR, book.getAuthor());
+}
+
+// Every term having a word below this node, each once
+// Gives up and returns false once that takes more than limit steps
+bool AutocompleteIndex::collectBelow(int node, size_t limit, std::vector<int>& found) const {
+    size_t steps = 0;
+    std::vector<int> pending(1, node);
+    while (!pending.empty()) {
+        int current = pending.back();
+        pending.pop_back();
+        steps++;
+        if (nodes[current].word != -1) {
+            steps += words[nodes[current].word].endings.size();
+        }
+        if (steps > limit) {
+            return false;
+        }
+
+        if (nodes[current].word != -1) {
+            const std::vector<int>& endings = words[nodes[current].word].endings;
+            found.insert(found.end(), endings.begin(), endings.end());
+        }
+        for (int child = nodes[current].firstChild; child != -1; child = nodes[child].nextSibling) {
+            pending.push_back(child);
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return true;
+}
+
+// Does a term have every earlier word, plus another word starting with the prefix?
+// Word ids are checked first, the text is only split for terms that pass
+bool AutocompleteIndex::matchesQuery(int id, const std::vector<int>& wanted, const std::vector<std::string>& typed) const {
+    const Term& term = terms[id];
+    for (int want : wanted) {
+        bool found = false;
+        for (const std::pair<int, int>& word : term.words) {
+            if (word.first == want) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+
+    const std::string& prefix = typed.back();
+    std::vector<std::string> tokens = tokenize(term.text);
+    for (const std::string& token : tokens) {
+        bool typedBefore = std::find(typed.begin(), typed.end() - 1, token) != typed.end() - 1;
+        if (!typedBefore && token.compare(0, prefix.size(), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A single word is answered straight from its node's list
+// With several words the lists only settle it when enough of their terms match,
+// since the best term having every word may be far down all of them. Failing
+// that, the terms of the earlier word used least or the terms below the prefix,
+// whichever is fewer, are filtered - the cost is one pass over the smaller set,
+// whatever the size of the rest of the catalog
+std::vector<AutocompleteIndex::Suggestion> AutocompleteIndex::suggest(const std::string& query, size_t count) const {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    std::vector<Suggestion> suggestions;
+    std::vector<std::string> typed = tokenize(query);
+    count = std::min(count, static_cast<size_t>(TOP_SIZE));
+
+    if (typed.empty() || count == 0) {
+        return suggestions;
+    }
+
+    const std::string& prefix = typed.back();
+    int prefixNode = findNode(prefix);
+    if (prefixNode == -1) {
+        return suggestions;
+    }
+
+    std::vector<int> matches(nodes[prefixNode].top.ids, nodes[prefixNode].top.ids + nodes[prefixNode].top.size);
+
+    if (typed.size() > 1) {
+        std::vector<int> wanted;
+        for (size_t i = 0; i + 1 < typed.size(); i++) {
+            int node = findNode(typed[i]);
+            if (node == -1 || nodes[node].word == -1) {
+                return suggestions;  // no term has this word
+            }
+            wanted.push_back(nodes[node].word);
+        }
+
+        // A list holds the best terms having its word or prefix, and every match has
+        // them all, so if enough of a list's terms match - or the list holds every
+        // term it could - nothing further down can outrank them
+        std::vector<const TopList*> lists(1, &nodes[prefixNode].top);
+        for (int word : wanted) {
+            lists.push_back(&words[word].top);
+        }
+        bool exact = false;
+        for (size_t l = 0; !exact && l < lists.size(); l++) {
+            const TopList* list = lists[l];
+            matches.clear();
+            for (int i = 0; i < list->size; i++) {
+                if (matchesQuery(list->ids[i], wanted, typed)) {
+                    matches.push_back(list->ids[i]);
+                }
+            }
+            exact = matches.size() >= count || list->size < TOP_SIZE;
+        }
+
+        // Otherwise every term of the earlier word used least is checked, or every
+        // term below the prefix if there are fewer of those
+        if (!exact) {
+            const Word* rarest = &words[wanted[0]];
+            for (int word : wanted) {
+                if (words[word].endings.size() < rarest->endings.size()) {
+                    rarest = &words[word];
+                }
+            }
+
+            std::vector<int> candidates;
+            if (!collectBelow(prefixNode, rarest->endings.size(), candidates)) {
+                candidates = rarest->endings;
+            }
+
+            matches.clear();
+            for (int id : candidates) {
+                if (matchesQuery(id, wanted, typed)) {
+                    matches.push_back(id);
+                }
+            }
+            size_t shown = std::min(count, matches.size());
+            std::partial_sort(matches.begin(), matches.begin() + shown, matches.end(),
+                [this](int a, int b) { return ranksAbove(a, b); });
+        }
+    }
+
+    for (size_t i = 0; i < matches.size() && i < count; i++) {
+        Suggestion suggestion;
+        suggestion.text = terms[matches[i]].text;
+        suggestion.kind = terms[matches[i]].kind;
+        suggestion.popularity = terms[matches[i]].popularity;
+        suggestions.push_back(suggestion);
+    }
+    return suggestions;
+}
+
+// Counts the big arrays and every string and list hanging off them
+size_t AutocompleteIndex::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    size_t bytes = nodes.capacity() * sizeof(Node) + words.capacity() * sizeof(Word) + terms.capacity() * sizeof(Term);
+
+    for (const Word& word : words) {
+        bytes += word.endings.capacity() * sizeof(int);
+    }
+    for (const Term& term : terms) {
+        bytes += term.text.capacity() + term.words.capacity() * sizeof(std::pair<int, int>);
+    }
+
+    // Hash table: buckets plus one node per term holding a copy of the key
+    bytes += termIds.bucket_count() * sizeof(void*);
+    for (const auto& entry : termIds) {
+        bytes += sizeof(entry) + sizeof(void*) + entry.first.capacity();
+    }
+    return bytes;
+}
@@ -0,0 +1,112 @@
+// AutocompleteIndex.h
+// Header file for the AutocompleteIndex class
+// Prefix tree over title and author words for search-as-you-type
+
+#ifndef AUTOCOMPLETEINDEX_H
+#define AUTOCOMPLETEINDEX_H
+
+#include "Book.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <mutex>
+
+class AutocompleteIndex {
+    public:
+        // What a suggestion completes to
+        enum Kind { TITLE, AUTHOR };
+
+        struct Suggestion {
+            std::string text;           // full title or author name
+            Kind kind;
+            unsigned long popularity;   // borrows since the term was added
+        };
+
+    private:
+        static const int TOP_SIZE = 10;  // completions remembered per tree node
+
+        // Most popular terms of a node or word, best first
+        // Fixed size so it lives inside its owner instead of on the heap
+        struct TopList {
+            int ids[TOP_SIZE];
+            int size;
+        };
+
+        // A distinct title or author name, shared by all books that have it
+        struct Term {
+            std::string text;
+            Kind kind;
+            int books;                  // how many catalog books use this term, 0 once removed
+            unsigned long popularity;
+            std::vector<std::pair<int, int> > words;  // per word of text: (word, slot in its endings)
+        };
+
+        // A complete word and every term that contains it
+        struct Word {
+            std::vector<int> endings;   // unordered, removal swaps with the last one
+            TopList top;
+        };
+
+        // One character step of a word prefix
+        // Children form a sibling chain sorted by character, so a node needs no
+        // allocation of its own - everything sits in the one nodes array
+        struct Node {
+            int firstChild;
+            int nextSibling;
+            int word;                   // word ending at this node, -1 if none
+            TopList top;                // most popular terms below this node
+            char letter;
+        };
+
+        std::vector<Term> terms;
+        std::vector<int> freeTerms;     // slots of removed terms, reused first
+        std::unordered_map<std::string, int> termIds;  // kind + text -> slot in terms
+        std::vector<Node> nodes;        // nodes[0] is the root
+        std::vector<Word> words;
+        mutable std::mutex indexMutex;
+
+        static std::string makeKey(Kind kind, const std::string& text);
+        static std::vector<std::string> tokenize(const std::string& text);
+
+        bool ranksAbove(int a, int b) const;
+        int findChild(int node, char c) const;
+        int findNode(const std::string& prefix) const;
+        bool collectBelow(int node, size_t limit, std::vector<int>& found) const;
+        bool matchesQuery(int id, const std::vector<int>& wanted, const std::vector<std::string>& typed) const;
+        void collectPath(const std::string& token, bool create, std::vector<int>& path);
+
+        void offer(TopList& list, int term) const;
+        static bool removeFrom(TopList& list, int term);
+        void repairWord(Word& word) const;
+        void repairNode(int node);
+
+        void addTerm(Kind kind, const std::string& text);
+        void removeTerm(Kind kind, const std::string& text);
+        void bumpTerm(Kind kind, const std::string& text);
+
+    public:
+        // Constructor
+        AutocompleteIndex();
+
+        // Keep the index in step with the catalog
+        // Adding and borrowing cost a walk down each word; removing also repairs
+        // the lists on those paths from the nodes just below them
+        void addBook(const Book& book);
+        void removeBook(const Book& book);
+        void updateBook(const Book& before, const Book& after);
+        void recordBorrow(const Book& book);
+
+        // Most popular titles and authors matching what was typed so far
+        // Earlier words must match whole words, the last one is treated as a prefix
+        // At most TOP_SIZE results; a single word costs a walk down the prefix
+        // With several words the short lists answer most queries, otherwise the
+        // cost is a pass over the terms of the rarest earlier word or of the
+        // prefix, whichever has fewer
+        std::vector<Suggestion> suggest(const std::string& query, size_t count) const;
+
+        // Rough size of the index in bytes
+        size_t getMemoryUsage() const;
+};
+
+#endif
@@ -0,0 +1,253 @@
+// CirculationStats.cpp
+// Implementation of CirculationStats class
+// Sliding window of time buckets, each holding Count-Min sketches and
+// Space-Saving counters, so memory stays fixed however many books circulate
+
+#include "CirculationStats.h"
+#include <algorithm>
+#include <functional>
+
+// Constructor - buckets are allocated up front, sketches on first use
+CirculationStats::CirculationStats(int bucketSeconds, int bucketCount, size_t trackedNames) : buckets(bucketCount > 0 ? bucketCount : 1), bucketSeconds(bucketSeconds > 0 ? bucketSeconds : 1), trackedNames(trackedNames > 0 ? trackedNames : 1) {
+    for (Bucket& bucket : buckets) {
+        bucket.start = -1;
+        bucket.borrows = 0;
+        bucket.returns = 0;
+    }
+    for (std::vector<unsigned int>& sketch : ringSketches) {
+        sketch.assign(SKETCH_DEPTH * SKETCH_WIDTH, 0);
+    }
+}
+
+// Find the bucket for this moment, recycling the slot if it holds old data
+// Caller must hold statsMutex
+CirculationStats::Bucket& CirculationStats::currentBucket(std::time_t now) {
+    long slot = static_cast<long>(now) / bucketSeconds;
+    Bucket& bucket = buckets[slot % buckets.size()];
+
+    if (bucket.start != slot * bucketSeconds) {
+        bucket.start = slot * bucketSeconds;
+        bucket.borrows = 0;
+        bucket.returns = 0;
+        for (int category = 0; category < CATEGORY_COUNT; category++) {
+            Summary& summary = bucket.summaries[category];
+            for (size_t i = 0; i < summary.sketch.size(); i++) {
+                ringSketches[category][i] -= summary.sketch[i];
+            }
+            summary.sketch.assign(SKETCH_DEPTH * SKETCH_WIDTH, 0);
+            summary.heavyHitters.clear();
+        }
+    }
+    return bucket;
+}
+
+// Count one borrow of a name in both structures, and in the ring's sketch total
+// Space-Saving: when full, the smallest counter is handed over to the new name
+void CirculationStats::addToSummary(Summary& summary, std::vector<unsigned int>& ringSketch, const std::string& name) {
+    size_t hash = std::hash<std::string>()(name);
+    size_t step = (hash >> 17) | 1;  // second hash for the remaining rows
+    for (int row = 0; row < SKETCH_DEPTH; row++) {
+        size_t cell = row * SKETCH_WIDTH + (hash + row * step) % SKETCH_WIDTH;
+        summary.sketch[cell]++;
+        ringSketch[cell]++;
+    }
+
+    std::unordered_map<std::string, unsigned long>::iterator found = summary.heavyHitters.find(name);
+    if (found != summary.heavyHitters.end()) {
+        found->second++;
+    } else if (summary.heavyHitters.size() < trackedNames) {
+        summary.heavyHitters[name] = 1;
+    } else {
+        std::unordered_map<std::string, unsigned long>::iterator smallest = summary.heavyHitters.begin();
+        for (found = summary.heavyHitters.begin(); found != summary.heavyHitters.end(); ++found) {
+            if (found->second < smallest->second) {
+                smallest = found;
+            }
+        }
+        unsigned long count = smallest->second;
+        summary.heavyHitters.erase(smallest);
+        summary.heavyHitters[name] = count + 1;
+    }
+}
+
+// Count-Min estimate - the smallest of the name's counters
+unsigned int CirculationStats::sketchEstimate(const std::vector<unsigned int>& sketch, size_t hash) {
+    if (sketch.empty()) {
+        return 0;
+    }
+
+    size_t step = (hash >> 17) | 1;
+    unsigned int estimate = sketch[hash % SKETCH_WIDTH];
+    for (int row = 1; row < SKETCH_DEPTH; row++) {
+        estimate = std::min(estimate, sketch[row * SKETCH_WIDTH + (hash + row * step) % SKETCH_WIDTH]);
+    }
+    return estimate;
+}
+
+// Smallest Space-Saving counter, 0 while there is still room for new names
+// An untracked name can't have been borrowed more often than this
+unsigned long CirculationStats::smallestCounter(const Summary& summary) const {
+    if (summary.heavyHitters.size() < trackedNames) {
+        return 0;
+    }
+
+    unsigned long smallest = summary.heavyHitters.begin()->second;
+    for (const auto& entry : summary.heavyHitters) {
+        smallest = std::min(smallest, entry.second);
+    }
+    return smallest;
+}
+
+// Borrows of one name in one bucket - both structures overestimate,
+// so the smaller answer is the better one
+unsigned long CirculationStats::bucketEstimate(const Summary& summary, const std::string& name, size_t hash, unsigned long smallest) const {
+    std::unordered_map<std::string, unsigned long>::const_iterator found = summary.heavyHitters.find(name);
+    unsigned long tracked = (found != summary.heavyHitters.end()) ? found->second : smallest;
+    return std::min<unsigned long>(tracked, sketchEstimate(summary.sketch, hash));
+}
+
+// Sketches add up, so the window's sketch is the sum of its buckets' sketches
+// Built from whichever side is smaller: adding up the buckets inside the
+// window, or taking the ring total and removing the ones outside it
+// Caller must hold statsMutex
+std::vector<unsigned int> CirculationStats::windowSketch(Category category, std::time_t now, int windowSeconds) const {
+    std::vector<const Summary*> inside;
+    std::vector<const Summary*> outside;
+    for (const Bucket& bucket : buckets) {
+        if (bucket.start >= 0) {
+            (inWindow(bucket, now, windowSeconds) ? inside : outside).push_back(&bucket.summaries[category]);
+        }
+    }
+
+    std::vector<unsigned int> sketch;
+    if (inside.size() <= outside.size()) {
+        sketch.assign(SKETCH_DEPTH * SKETCH_WIDTH, 0);
+        for (const Summary* summary : inside) {
+            for (size_t i = 0; i < sketch.size(); i++) {
+                sketch[i] += summary->sketch[i];
+            }
+        }
+    } else {
+        sketch = ringSketches[category];
+        for (const Summary* summary : outside) {
+            for (size_t i = 0; i < sketch.size(); i++) {
+                sketch[i] -= summary->sketch[i];
+            }
+        }
+    }
+    return sketch;
+}
+
+// Does any part of this bucket fall inside the last windowSeconds?
+bool CirculationStats::inWindow(const Bucket& bucket, std::time_t now, int windowSeconds) const {
+    return bucket.start >= 0 && bucket.start <= now && bucket.start + bucketSeconds > now - windowSeconds;
+}
+
+// Record a successful checkout under its title, author and genre
+void CirculationStats::recordBorrow(const Book& book, std::time_t when) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    Bucket& bucket = currentBucket(when);
+
+    bucket.borrows++;
+    addToSummary(bucket.summaries[TITLE], ringSketches[TITLE], book.getTitle());
+    addToSummary(bucket.summaries[AUTHOR], ringSketches[AUTHOR], book.getAuthor());
+    addToSummary(bucket.summaries[GENRE], ringSketches[GENRE], book.getGenre());
+}
+
+// Returns only count towards the totals, popularity is measured by borrows
+void CirculationStats::recordReturn(std::time_t when) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    currentBucket(when).returns++;
+}
+
+// Candidates are the names tracked by any bucket in the window
+// Each gets a cheap upper bound: the smaller of its Space-Saving counters
+// (the smallest counter where it isn't tracked) and the window sketch, which
+// costs four reads instead of one per bucket. Per-bucket estimates are then
+// worked out best bound first, stopping as soon as no remaining bound can
+// beat the current top list - for skewed borrowing only a few are needed
+std::vector<PopularityEntry> CirculationStats::topBorrowed(Category category, size_t count, int windowSeconds, std::time_t now) const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    std::vector<const Summary*> window;
+    std::vector<unsigned long> smallest;
+    unsigned long untrackedBound = 0;  // what a name tracked nowhere could have, summed
+
+    for (const Bucket& bucket : buckets) {
+        if (inWindow(bucket, now, windowSeconds)) {
+            window.push_back(&bucket.summaries[category]);
+            smallest.push_back(smallestCounter(bucket.summaries[category]));
+            untrackedBound += smallest.back();
+        }
+    }
+
+    // Space-Saving bound = tracked counts + smallest counter of every bucket not tracking the name
+    std::unordered_map<std::string, unsigned long> bounds;
+    for (size_t b = 0; b < window.size(); b++) {
+        for (const auto& entry : window[b]->heavyHitters) {
+            std::unordered_map<std::string, unsigned long>::iterator found = bounds.find(entry.first);
+            if (found == bounds.end()) {
+                found = bounds.insert(std::make_pair(entry.first, untrackedBound)).first;
+            }
+            found->second += entry.second - smallest[b];
+        }
+    }
+
+    std::vector<unsigned int> sketch = windowSketch(category, now, windowSeconds);
+    std::vector<std::pair<unsigned long, std::string> > candidates;
+    for (const auto& entry : bounds) {
+        unsigned long sketchBound = sketchEstimate(sketch, std::hash<std::string>()(entry.first));
+        candidates.push_back(std::make_pair(std::min(entry.second, sketchBound), entry.first));
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](const std::pair<unsigned long, std::string>& a, const std::pair<unsigned long, std::string>& b) {
+            return a.first > b.first;
+        });
+
+    // Most borrowed first, ties in alphabetical order
+    auto ranksAbove = [](const PopularityEntry& a, const PopularityEntry& b) {
+        return a.borrows != b.borrows ? a.borrows > b.borrows : a.name < b.name;
+    };
+
+    std::vector<PopularityEntry> ranking;
+    for (const std::pair<unsigned long, std::string>& candidate : candidates) {
+        if (ranking.size() >= count && candidate.first < ranking.back().borrows) {
+            break;
+        }
+
+        PopularityEntry item;
+        item.name = candidate.second;
+        item.borrows = 0;
+        size_t hash = std::hash<std::string>()(item.name);
+        for (size_t b = 0; b < window.size(); b++) {
+            item.borrows += bucketEstimate(*window[b], item.name, hash, smallest[b]);
+        }
+
+        ranking.insert(std::upper_bound(ranking.begin(), ranking.end(), item, ranksAbove), item);
+        if (ranking.size() > count) {
+            ranking.pop_back();
+        }
+    }
+    return ranking;
+}
+
+unsigned long CirculationStats::getBorrowCount(int windowSeconds, std::time_t now) const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    unsigned long total = 0;
+    for (const Bucket& bucket : buckets) {
+        if (inWindow(bucket, now, windowSeconds)) {
+            total += bucket.borrows;
+        }
+    }
+    return total;
+}
+
+unsigned long CirculationStats::getReturnCount(int windowSeconds, std::time_t now) const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    unsigned long total = 0;
+    for (const Bucket& bucket : buckets) {
+        if (inWindow(bucket, now, windowSeconds)) {
+            total += bucket.returns;
+        }
+    }
+    return total;
+}
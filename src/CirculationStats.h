@@ -0,0 +1,79 @@
+// CirculationStats.h
+// Header file for the CirculationStats class
+// Tracks which titles, authors and genres are borrowed most, in fixed memory
+
+#ifndef CIRCULATIONSTATS_H
+#define CIRCULATIONSTATS_H
+
+#include "Book.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <ctime>
+
+// One line of a popularity ranking
+struct PopularityEntry {
+    std::string name;
+    unsigned long borrows;  // estimated borrows inside the window
+};
+
+class CirculationStats {
+    public:
+        // What a borrow is counted under
+        enum Category { TITLE, AUTHOR, GENRE };
+
+    private:
+        static const int CATEGORY_COUNT = 3;
+        static const int SKETCH_DEPTH = 4;      // hash rows in each Count-Min sketch
+        static const int SKETCH_WIDTH = 512;    // counters per row
+
+        // Counters for one category during one time bucket
+        struct Summary {
+            std::vector<unsigned int> sketch;   // Count-Min: SKETCH_DEPTH rows of SKETCH_WIDTH
+            std::unordered_map<std::string, unsigned long> heavyHitters;  // Space-Saving counters
+        };
+
+        // Everything that happened during one slice of time
+        struct Bucket {
+            long start;             // first second covered, -1 if never used
+            unsigned long borrows;
+            unsigned long returns;
+            Summary summaries[CATEGORY_COUNT];
+        };
+
+        std::vector<Bucket> buckets;    // ring of the most recent time slices
+        std::vector<unsigned int> ringSketches[CATEGORY_COUNT];  // every bucket's sketch added up
+        int bucketSeconds;
+        size_t trackedNames;            // Space-Saving capacity per category and bucket
+        mutable std::mutex statsMutex;
+
+        Bucket& currentBucket(std::time_t now);
+        void addToSummary(Summary& summary, std::vector<unsigned int>& ringSketch, const std::string& name);
+        static unsigned int sketchEstimate(const std::vector<unsigned int>& sketch, size_t hash);
+        std::vector<unsigned int> windowSketch(Category category, std::time_t now, int windowSeconds) const;
+        unsigned long smallestCounter(const Summary& summary) const;
+        unsigned long bucketEstimate(const Summary& summary, const std::string& name, size_t hash, unsigned long smallest) const;
+        bool inWindow(const Bucket& bucket, std::time_t now, int windowSeconds) const;
+
+    public:
+        // Constructor - default keeps one week of hourly buckets
+        CirculationStats(int bucketSeconds = 3600, int bucketCount = 168, size_t trackedNames = 32);
+
+        // Feed events from the checkout desk - constant time, no event log kept
+        void recordBorrow(const Book& book, std::time_t when);
+        void recordReturn(std::time_t when);
+
+        // Most borrowed names in the last windowSeconds, highest first
+        // Counts may overestimate but never underestimate
+        std::vector<PopularityEntry> topBorrowed(Category category, size_t count, int windowSeconds, std::time_t now) const;
+
+        // Totals for the window
+        unsigned long getBorrowCount(int windowSeconds, std::time_t now) const;
+        unsigned long getReturnCount(int windowSeconds, std::time_t now) const;
+
+        // Longest window that can be answered
+        int getMaxWindowSeconds() const { return bucketSeconds * static_cast<int>(buckets.size()); }
+};
+
+#endif
@@ -5,26 +5,60 @@
 #include "Library.h"
 #include <iostream>
 #include <iomanip>
-#include <algorithm>
+#include <ctime>
+#include <unordered_map>
 
 // Constructor - initialize library with a name
-Library::Library(const std::string& name) : libraryName(name) {
-// catalog vector is automatically initialized as empty
+Library::Library(const std::string& name) : catalog(std::make_shared<BookList>()), releaseMutex(std::make_shared<std::mutex>()), libraryName(name) {
+// catalog starts as an empty list that no snapshot shares yet
 }
 
 // Private helper function to locate a book
 // Linear search through catalog - simple but works fine for reasonable collection sizes
 int Library::findBookIndex(const std::string& isbn) const {
-    for (size_t i = 0; i < catalog.size(); i++) {
-        if (catalog[i].getISBN() == isbn) {
+    for (size_t i = 0; i < catalog->size(); i++) {
+        if ((*catalog)[i]->getISBN() == isbn) {
             return i;  // found it!
         }
     }
     return -1;  // not found
 }
 
+// Make sure the list we are about to change is not visible to any snapshot
+// Only the pointers are copied, the books themselves stay shared
+// A reference is only ever dropped under releaseMutex, and a new one comes either
+// from snapshot() under catalogMutex or from copying a live snapshot, which
+// already holds a reference itself - so a count of one means no reader is left.
+// Any new way of getting at the list has to keep to that
+Library::BookList& Library::writableCatalog() {
+    std::lock_guard<std::mutex> release(*releaseMutex);
+    if (catalog.use_count() > 1) {
+        catalog = std::make_shared<BookList>(*catalog);
+    }
+    return *catalog;
+}
+
+// Same idea for a single book - copy it if a snapshot still sees it
+Book* Library::writableBook(int index) {
+    BookList& books = writableCatalog();
+    std::lock_guard<std::mutex> release(*releaseMutex);
+    if (books[index].use_count() > 1) {
+        books[index] = std::make_shared<Book>(*books[index]);
+    }
+    return books[index].get();
+}
+
+// Publish the current catalog to a reader
+// Only the pointer copy happens under the lock, reading is lock-free afterwards
+CatalogSnapshot Library::snapshot() const {
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    return CatalogSnapshot(catalog, releaseMutex);
+}
+
 // Add a new book to the library
 bool Library::addBook(const Book& book) {
+    std::lock_guard<std::mutex> lock(catalogMutex);
+
     // Check if book with same ISBN already exists
     if (findBookIndex(book.getISBN()) != -1) {
         std::cout << "Book with ISBN " << book.getISBN() << " already exists in catalog." << std::endl;
@@ -32,13 +66,20 @@ bool Library::addBook(const Book& book) {
     }
 
     // Add to catalog using vector's push_back
-    catalog.push_back(book);
+    writableCatalog().push_back(std::make_shared<Book>(book));
+
+    // Only cached queries the new book matches need to go
+    searchCache.invalidate(SearchCache::TITLE, book.getTitle());
+    searchCache.invalidate(SearchCache::AUTHOR, book.getAuthor());
+    searchCache.invalidate(SearchCache::GENRE, book.getGenre());
+    autocomplete.addBook(book);
     std::cout << "Successfully added: " << book.getTitle() << std::endl;
     return true;
 }
 
 // Remove a book completely from the catalog
 bool Library::removeBook(const std::string& isbn) {
+    std::lock_guard<std::mutex> lock(catalogMutex);
     int index = findBookIndex(isbn);
 
     if (index == -1) {
@@ -47,19 +88,27 @@ bool Library::removeBook(const std::string& isbn) {
     }
 
     // Check if any copies are currently borrowed
-    if (catalog[index].getAvailableCopies() < catalog[index].getTotalCopies()) {
+    const Book& book = *(*catalog)[index];
+    if (book.getAvailableCopies() < book.getTotalCopies()) {
         std::cout << "Cannot remove book: Some copies are currently borrowed." << std::endl;
         return false;
     }
 
     // erase removes element at given position
-    catalog.erase(catalog.begin() + index);
+    searchCache.invalidate(SearchCache::TITLE, book.getTitle());
+    searchCache.invalidate(SearchCache::AUTHOR, book.getAuthor());
+    searchCache.invalidate(SearchCache::GENRE, book.getGenre());
+    autocomplete.removeBook(book);
+
+    BookList& books = writableCatalog();
+    books.erase(books.begin() + index);
     std::cout << "Book removed from catalog." << std::endl;
     return true;
 }
 
 // Process a book borrowing
 bool Library::borrowBook(const std::string& isbn) {
+    std::lock_guard<std::mutex> lock(catalogMutex);
     int index = findBookIndex(isbn);
 
     if (index == -1) {
@@ -68,12 +117,21 @@ bool Library::borrowBook(const std::string& isbn) {
     }
 
     // Delegate to Book class's borrowBook method
-    return catalog[index].borrowBook();
+    // Cached searches hold ISBNs only, so availability changes don't invalidate them
+    Book* book = writableBook(index);
+    if (!book->borrowBook()) {
+        return false;
+    }
+
+    circulation.recordBorrow(*book, std::time(nullptr));
+    autocomplete.recordBorrow(*book);
+    return true;
 
 }
 
 // Process a book return
 bool Library::returnBook(const std::string& isbn) {
+    std::lock_guard<std::mutex> lock(catalogMutex);
     int index = findBookIndex(isbn);
 
     if (index == -1) {
@@ -81,12 +139,18 @@ bool Library::returnBook(const std::string& isbn) {
         return false;
     }
 
-    return catalog[index].returnBook();
+    if (!writableBook(index)->returnBook()) {
+        return false;
+    }
+
+    circulation.recordReturn(std::time(nullptr));
+    return true;
 }
 
 // Find and return pointer to a book
 // Returns nullptr if not found
-Book* Library::findBook(const std::string& isbn) {
+const Book* Library::findBook(const std::string& isbn) const {
+    std::lock_guard<std::mutex> lock(catalogMutex);
     int index = findBookIndex(isbn);
 
     if (index == -1) {
@@ -94,11 +158,13 @@ Book* Library::findBook(const std::string& isbn) {
     }
 
     // Return address of the book in catalog
-    return &catalog[index];
+    return (*catalog)[index].get();
 }
 
 // Display all books in a nice table format
 void Library::displayAllBooks() const {
+    CatalogSnapshot catalog = snapshot();
+
     if (catalog.empty()) {
     std::cout << "The library catalog is empty." << std::endl;
     return;
@@ -109,8 +175,8 @@ void Library::displayAllBooks() const {
     std::cout << std::left << std::setw(15) << "ISBN" << std::setw(30) << "Title" << std::setw(20) << "Author" << "Copies (Avail/Total)" << std::endl;
     std::cout << "----------------------------------------" << std::endl;
 
-    for (const Book& book : catalog) {
-        book.displayInfo();
+    for (size_t i = 0; i < catalog.size(); i++) {
+        catalog[i].displayInfo();
     }
     std::cout << "\nTotal books in catalog: " << catalog.size() << "\n" << std::endl;
 }
@@ -120,8 +186,10 @@ void Library::displayAvailableBooks() const {
     std::cout << "\n" << libraryName << " - Available Books" << std::endl;
     std::cout << "========================================" << std::endl;
 
+    CatalogSnapshot catalog = snapshot();
     int count = 0;
-    for (const Book& book : catalog) {
+    for (size_t i = 0; i < catalog.size(); i++) {
+        const Book& book = catalog[i];
         if (book.canBeBorrowed() && book.getAvailableCopies() > 0) {
             book.displayInfo();
             count++;
@@ -134,25 +202,83 @@ void Library::displayAvailableBooks() const {
     std::cout << std::endl;
 }
 
+// Pick the field a search compares against
+std::string Library::fieldValue(const Book& book, SearchCache::Field field) {
+    switch (field) {
+        case SearchCache::TITLE:
+            return book.getTitle();
+        case SearchCache::AUTHOR:
+            return book.getAuthor();
+        default:
+            return book.getGenre();
+    }
+}
+
+// Case-insensitive partial match on one field
+// The cache is checked before the snapshot is taken, so an invalidation
+// racing with this search stops its result from being stored
+CatalogSnapshot Library::searchCatalog(SearchCache::Field field, const std::string& term, std::vector<size_t>& matches) const {
+    std::string searchTerm = SearchCache::normalize(term);
+    CachedResult cached;
+    unsigned long generation;
+    bool hit = searchCache.lookup(field, searchTerm, cached, generation);
+    CatalogSnapshot catalog = snapshot();
+
+    if (hit) {
+        // Positions only move when a book is removed - then one pass over the
+        // snapshot maps every ISBN to its new place, however many hints are stale
+        bool moved = false;
+        std::unordered_map<std::string, size_t> positionOf;
+        for (size_t i = 0; i < cached.isbns.size(); i++) {
+            size_t position = cached.positions[i];
+            if (position >= catalog.size() || catalog[position].getISBN() != cached.isbns[i]) {
+                if (positionOf.empty()) {
+                    for (size_t j = 0; j < catalog.size(); j++) {
+                        positionOf[catalog[j].getISBN()] = j;
+                    }
+                }
+                std::unordered_map<std::string, size_t>::const_iterator found = positionOf.find(cached.isbns[i]);
+                if (found == positionOf.end()) {
+                    continue;  // removed after our snapshot was taken
+                }
+                position = found->second;
+                cached.positions[i] = position;
+                moved = true;
+            }
+            matches.push_back(position);
+        }
+
+        if (moved && matches.size() == cached.isbns.size()) {
+            searchCache.store(field, searchTerm, cached, generation);
+        }
+        return catalog;
+    }
+
+    CachedResult result;
+    for (size_t i = 0; i < catalog.size(); i++) {
+        std::string value = SearchCache::normalize(fieldValue(catalog[i], field));
+        if (value.find(searchTerm) != std::string::npos) {
+            matches.push_back(i);
+            result.isbns.push_back(catalog[i].getISBN());
+            result.positions.push_back(i);
+        }
+    }
+
+    searchCache.store(field, searchTerm, result, generation);
+    return catalog;
+}
+
 // Search for books by title (case-insensitive partial match)
 void Library::searchByTitle(const std::string& title) const {
     std::cout << "\nSearch Results for Title: "" << title << """ << std::endl;
     std::cout << "========================================" << std::endl;
 
+    std::vector<size_t> matches;
+    CatalogSnapshot catalog = searchCatalog(SearchCache::TITLE, title, matches);
     int found = 0;
-    for (const Book& book : catalog) {
-        // Convert both strings to lowercase for comparison
-        std::string bookTitle = book.getTitle();
-        std::string searchTerm = title;
-        
-        // Simple case-insensitive search
-        std::transform(bookTitle.begin(), bookTitle.end(), bookTitle.begin(), ::tolower);
-        std::transform(searchTerm.begin(), searchTerm.end(), searchTerm.begin(), ::tolower);
-        
-        if (bookTitle.find(searchTerm) != std::string::npos) {
-            book.displayDetailedInfo();
-            found++;
-        }
+    for (size_t index : matches) {
+        catalog[index].displayDetailedInfo();
+        found++;
     }
 
     if (found == 0) {
@@ -167,18 +293,12 @@ void Library::searchByAuthor(const std::string& author) const {
     std::cout << "\nSearch Results for Author: "" << author << """ << std::endl;
     std::cout << "========================================" << std::endl;
 
+    std::vector<size_t> matches;
+    CatalogSnapshot catalog = searchCatalog(SearchCache::AUTHOR, author, matches);
     int found = 0;
-    for (const Book& book : catalog) {
-        std::string bookAuthor = book.getAuthor();
-        std::string searchTerm = author;
-        
-        std::transform(bookAuthor.begin(), bookAuthor.end(), bookAuthor.begin(), ::tolower);
-        std::transform(searchTerm.begin(), searchTerm.end(), searchTerm.begin(), ::tolower);
-        
-        if (bookAuthor.find(searchTerm) != std::string::npos) {
-            book.displayDetailedInfo();
-            found++;
-        }
+    for (size_t index : matches) {
+        catalog[index].displayDetailedInfo();
+        found++;
     }
 
     if (found == 0) {
@@ -193,18 +313,12 @@ void Library::searchByGenre(const std::string& genre) const {
     std::cout << "\nSearch Results for Genre: "" << genre << """ << std::endl;
     std::cout << "========================================" << std::endl;
 
+    std::vector<size_t> matches;
+    CatalogSnapshot catalog = searchCatalog(SearchCache::GENRE, genre, matches);
     int found = 0;
-    for (const Book& book : catalog) {
-        std::string bookGenre = book.getGenre();
-        std::string searchTerm = genre;
-        
-        std::transform(bookGenre.begin(), bookGenre.end(), bookGenre.begin(), ::tolower);
-        std::transform(searchTerm.begin(), searchTerm.end(), searchTerm.begin(), ::tolower);
-        
-        if (bookGenre.find(searchTerm) != std::string::npos) {
-            book.displayDetailedInfo();
-            found++;
-        }
+    for (size_t index : matches) {
+        catalog[index].displayDetailedInfo();
+        found++;
     }
 
     if (found == 0) {
@@ -214,16 +328,42 @@ void Library::searchByGenre(const std::string& genre) const {
     }
 }
 
+// Suggestions come from the prefix index, the catalog is never scanned
+std::vector<AutocompleteIndex::Suggestion> Library::suggest(const std::string& prefix, size_t count) const {
+    return autocomplete.suggest(prefix, count);
+}
+
+// Short list of completions for the kiosk
+void Library::displaySuggestions(const std::string& prefix) const {
+    std::vector<AutocompleteIndex::Suggestion> suggestions = suggest(prefix);
+
+    if (suggestions.empty()) {
+        std::cout << "No suggestions for \"" << prefix << "\"." << std::endl;
+        return;
+    }
+
+    std::cout << "\nSuggestions for \"" << prefix << "\"" << std::endl;
+    std::cout << "========================================" << std::endl;
+    for (const AutocompleteIndex::Suggestion& suggestion : suggestions) {
+        std::cout << std::left << std::setw(30) << suggestion.text
+        << std::setw(10) << (suggestion.kind == AutocompleteIndex::TITLE ? "Title" : "Author")
+        << suggestion.popularity << " borrows" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
 // Modify the number of copies for a book
 // Positive change adds copies, negative removes them
 bool Library::updateBookCopies(const std::string& isbn, int change) {
-    Book* book = findBook(isbn);
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    int index = findBookIndex(isbn);
 
-    if (book == nullptr) {
+    if (index == -1) {
         std::cout << "Book not found." << std::endl;
         return false;
     }
 
+    Book* book = writableBook(index);
     if (change > 0) {
         book->addCopies(change);
         return true;
@@ -235,48 +375,155 @@ bool Library::updateBookCopies(const std::string& isbn, int change) {
     }
 }
 
+// Change title, author and genre of a book
+// Cached searches are dropped only for the fields that actually changed
+bool Library::updateBookInfo(const std::string& isbn, const std::string& title, const std::string& author, const std::string& genre) {
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    int index = findBookIndex(isbn);
+
+    if (index == -1) {
+        std::cout << "Book not found." << std::endl;
+        return false;
+    }
+
+    Book* book = writableBook(index);
+    Book before = *book;
+    if (book->getTitle() != title) {
+        searchCache.invalidate(SearchCache::TITLE, book->getTitle());
+        searchCache.invalidate(SearchCache::TITLE, title);
+        book->setTitle(title);
+    }
+    if (book->getAuthor() != author) {
+        searchCache.invalidate(SearchCache::AUTHOR, book->getAuthor());
+        searchCache.invalidate(SearchCache::AUTHOR, author);
+        book->setAuthor(author);
+    }
+    if (book->getGenre() != genre) {
+        searchCache.invalidate(SearchCache::GENRE, book->getGenre());
+        searchCache.invalidate(SearchCache::GENRE, genre);
+        book->setGenre(genre);
+    }
+    autocomplete.updateBook(before, *book);
+
+    std::cout << "Book details updated." << std::endl;
+    return true;
+}
+
 // Enable or disable borrowing for a specific book
 bool Library::setBorrowStatus(const std::string& isbn, bool status) {
-    Book* book = findBook(isbn);
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    int index = findBookIndex(isbn);
 
-    if (book == nullptr) {
+    if (index == -1) {
         std::cout << "Book not found." << std::endl;
         return false;
     }
 
-    book->setBorrowStatus(status);
+    writableBook(index)->setBorrowStatus(status);
     std::cout << "Borrow status updated to: " 
             << (status ? "Available" : "Not Available") << std::endl;
     return true;
 
 }
 
-// Calculate total copies across all books
-int Library::getTotalCopies() const {
+// Swap views - the old books are released under their own library's mutex,
+// then both pointers are taken from other, which may belong to another library
+CatalogSnapshot& CatalogSnapshot::operator=(const CatalogSnapshot& other) {
+    if (this != &other) {
+        {
+            std::lock_guard<std::mutex> release(*releaseMutex);
+            books.reset();
+        }
+        books = other.books;  // other still holds them, so this count can't reach one
+        releaseMutex = other.releaseMutex;
+    }
+    return *this;
+}
+
+// Dropping the last reference may also free old books, both happen under the lock
+CatalogSnapshot::~CatalogSnapshot() {
+    std::lock_guard<std::mutex> release(*releaseMutex);
+    books.reset();
+}
+
+// Calculate total copies across all books in this view
+int CatalogSnapshot::getTotalCopies() const {
     int total = 0;
-    for (const Book& book : catalog) {
-    total += book.getTotalCopies();
+    for (size_t i = 0; i < books->size(); i++) {
+    total += (*books)[i]->getTotalCopies();
     }
     return total;
 }
 
-// Calculate available copies across all books
-int Library::getAvailableCopies() const {
+// Calculate available copies across all books in this view
+int CatalogSnapshot::getAvailableCopies() const {
     int available = 0;
-    for (const Book& book : catalog) {
-    available += book.getAvailableCopies();
+    for (size_t i = 0; i < books->size(); i++) {
+    available += (*books)[i]->getAvailableCopies();
     }
     return available;
 }
 
+// Calculate total copies across all books
+int Library::getTotalCopies() const {
+    return snapshot().getTotalCopies();
+}
+
+// Calculate available copies across all books
+int Library::getAvailableCopies() const {
+    return snapshot().getAvailableCopies();
+}
+
 // Display library statistics
+// Everything comes from one snapshot so borrowed copies can never go negative
 void Library::displayLibraryInfo() const {
+    CatalogSnapshot catalog = snapshot();
+    int totalCopies = catalog.getTotalCopies();
+    int availableCopies = catalog.getAvailableCopies();
+
     std::cout << "\n========================================" << std::endl;
     std::cout << "Library: " << libraryName << std::endl;
     std::cout << "========================================" << std::endl;
     std::cout << "Unique Titles: " << catalog.size() << std::endl;
-    std::cout << "Total Copies: " << getTotalCopies() << std::endl;
-    std::cout << "Available Copies: " << getAvailableCopies() << std::endl;
-    std::cout << "Borrowed Copies: " << (getTotalCopies() - getAvailableCopies()) << std::endl;
+    std::cout << "Total Copies: " << totalCopies << std::endl;
+    std::cout << "Available Copies: " << availableCopies << std::endl;
+    std::cout << "Borrowed Copies: " << (totalCopies - availableCopies) << std::endl;
+    std::cout << "----------------------------------------" << std::endl;
+    searchCache.displayStats();
+    std::cout << "Autocomplete Index: about " << autocomplete.getMemoryUsage() << " bytes" << std::endl;
+    std::cout << "========================================\n" << std::endl;
+}
+
+// Show what circulates most - answered from the sketches, no catalog scan
+void Library::displayCirculationReport(int windowHours, int count) const {
+    // Checked before multiplying so huge input can't overflow
+    int maxHours = circulation.getMaxWindowSeconds() / 3600;
+    if (windowHours <= 0 || windowHours > maxHours) {
+        std::cout << "Window must be between 1 and " << maxHours << " hours." << std::endl;
+        return;
+    }
+    int windowSeconds = windowHours * 3600;
+
+    std::time_t now = std::time(nullptr);
+    const char* headings[] = { "Top Titles", "Top Authors", "Top Genres" };
+    const CirculationStats::Category categories[] = { CirculationStats::TITLE, CirculationStats::AUTHOR, CirculationStats::GENRE };
+
+    std::cout << "\n" << libraryName << " - Circulation (last " << windowHours << " hours)" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Borrows: " << circulation.getBorrowCount(windowSeconds, now) << std::endl;
+    std::cout << "Returns: " << circulation.getReturnCount(windowSeconds, now) << std::endl;
+
+    for (int i = 0; i < 3; i++) {
+        std::vector<PopularityEntry> ranking = circulation.topBorrowed(categories[i], count, windowSeconds, now);
+
+        std::cout << "----------------------------------------" << std::endl;
+        std::cout << headings[i] << std::endl;
+        if (ranking.empty()) {
+            std::cout << "No borrowing activity yet." << std::endl;
+        }
+        for (const PopularityEntry& entry : ranking) {
+            std::cout << std::left << std::setw(30) << entry.name << entry.borrows << std::endl;
+        }
+    }
     std::cout << "========================================\n" << std::endl;
 }
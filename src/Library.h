@@ -6,18 +6,67 @@
 #define LIBRARY_H
 
 #include "Book.h"
+#include "SearchCache.h"
+#include "CirculationStats.h"
+#include "AutocompleteIndex.h"
 #include <vector>
 #include <string>
+#include <memory>
+#include <mutex>
+
+// Read-only, point-in-time view of the catalog
+// Taking one only copies a shared pointer; the books it sees never change
+// afterwards, so long reports get consistent numbers while borrowing goes on
+class CatalogSnapshot {
+    private:
+        typedef std::vector<std::shared_ptr<Book> > BookList;
+        std::shared_ptr<const BookList> books;
+        std::shared_ptr<std::mutex> releaseMutex;  // shared with the Library, see the destructor
+
+    public:
+        CatalogSnapshot(std::shared_ptr<const BookList> books, std::shared_ptr<std::mutex> releaseMutex) : books(books), releaseMutex(releaseMutex) {}
+        CatalogSnapshot(const CatalogSnapshot& other) = default;
+        CatalogSnapshot& operator=(const CatalogSnapshot& other);
+
+        // Lets go of the books under releaseMutex, so the Library can tell
+        // exactly when nobody reads them anymore
+        ~CatalogSnapshot();
+
+        size_t size() const { return books->size(); }
+        bool empty() const { return books->empty(); }
+        const Book& operator[](size_t index) const { return *(*books)[index]; }
+
+        // Totals computed from the same view always add up
+        int getTotalCopies() const;
+        int getAvailableCopies() const;
+};
 
 class Library {
     private:
-        std::vector<Book> catalog;    // dynamic array to store all books
+        typedef std::vector<std::shared_ptr<Book> > BookList;
+
+        std::shared_ptr<BookList> catalog;  // shared with snapshots until the next write
+        mutable std::mutex catalogMutex;    // held by writers and while taking a snapshot
+        std::shared_ptr<std::mutex> releaseMutex;  // held while snapshots drop their books
         std::string libraryName;
+        mutable SearchCache searchCache;    // recent search results, kept in sync by every writer
+        CirculationStats circulation;       // borrow popularity over the last week
+        AutocompleteIndex autocomplete;     // title and author prefixes for search-as-you-type
 
         // Helper method to find a book by ISBN
         // Returns -1 if not found, otherwise returns index in catalog
         int findBookIndex(const std::string& isbn) const;
 
+        // Copy-on-write helpers - caller must hold catalogMutex
+        // Any list or book still held by a live snapshot is copied before it is modified
+        BookList& writableCatalog();
+        Book* writableBook(int index);
+
+        // Shared body of the three searches - fills matches with positions in the returned snapshot
+        // Repeated queries are answered from searchCache instead of scanning the catalog
+        CatalogSnapshot searchCatalog(SearchCache::Field field, const std::string& term, std::vector<size_t>& matches) const;
+        static std::string fieldValue(const Book& book, SearchCache::Field field);
+
     public:
         // Constructor
         Library(const std::string& name = "City Library");
@@ -28,25 +77,41 @@ class Library {
         bool borrowBook(const std::string& isbn);
         bool returnBook(const std::string& isbn);
 
+        // Point-in-time view for reports and exports
+        CatalogSnapshot snapshot() const;
+
         // Search and display functions
-        Book* findBook(const std::string& isbn);
+        // Read-only - changes go through the Library methods below
+        // Returned pointer is only safe to use while no other thread changes the library,
+        // concurrent readers should take a snapshot() instead
+        const Book* findBook(const std::string& isbn) const;
         void displayAllBooks() const;
         void displayAvailableBooks() const;
         void searchByTitle(const std::string& title) const;
         void searchByAuthor(const std::string& author) const;
         void searchByGenre(const std::string& genre) const;
 
+        // Search-as-you-type - popular titles and authors starting with what was typed
+        std::vector<AutocompleteIndex::Suggestion> suggest(const std::string& prefix, size_t count = 5) const;
+        void displaySuggestions(const std::string& prefix) const;
+
         // Stock management
         bool updateBookCopies(const std::string& isbn, int change);
         bool setBorrowStatus(const std::string& isbn, bool status);
 
+        // Edit descriptive fields - use this rather than Book setters so searches stay correct
+        bool updateBookInfo(const std::string& isbn, const std::string& title, const std::string& author, const std::string& genre);
+
         // Statistics
-        int getTotalBooks() const { return catalog.size(); }
+        int getTotalBooks() const { return snapshot().size(); }
         int getTotalCopies() const;
         int getAvailableCopies() const;
 
         // Display library info
         void displayLibraryInfo() const;
+
+        // Most borrowed titles, authors and genres over the last few hours
+        void displayCirculationReport(int windowHours, int count = 5) const;
 };
 
 #endif
@@ -0,0 +1,121 @@
+// SearchCache.cpp
+// Implementation of SearchCache class
+// Least recently used cache of search results with targeted invalidation
+
+#include "SearchCache.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+// Constructor - an empty cache holding at most capacity queries
+SearchCache::SearchCache(size_t capacity) : capacity(capacity), generation(0), hits(0), misses(0), evictions(0), invalidations(0), memoryBytes(0) {}
+
+// Same case-insensitive form the searches use
+std::string SearchCache::normalize(const std::string& text) {
+    std::string result = text;
+    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+    return result;
+}
+
+// Field goes first so "Fiction" as a title and as a genre stay separate
+std::string SearchCache::makeKey(Field field, const std::string& term) {
+    return std::string(1, static_cast<char>('0' + field)) + term;
+}
+
+// Approximate memory held by one entry, including its lookup table slot
+size_t SearchCache::entrySize(const Entry& entry) {
+    size_t size = sizeof(Entry) + 2 * entry.term.size();
+    for (const std::string& isbn : entry.result.isbns) {
+        size += sizeof(std::string) + isbn.size();
+    }
+    size += entry.result.positions.size() * sizeof(size_t);
+    return size;
+}
+
+// Remove one entry and its bookkeeping - caller must hold cacheMutex
+void SearchCache::eraseEntry(EntryList::iterator it) {
+    memoryBytes -= entrySize(*it);
+    lookupTable.erase(makeKey(it->field, it->term));
+    entries.erase(it);
+}
+
+// A hit is one hash lookup plus moving the entry to the front of the list
+bool SearchCache::lookup(Field field, const std::string& term, CachedResult& result, unsigned long& generationSeen) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    generationSeen = generation;
+
+    std::unordered_map<std::string, EntryList::iterator>::iterator found = lookupTable.find(makeKey(field, term));
+    if (found == lookupTable.end()) {
+        misses++;
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, found->second);
+    result = found->second->result;
+    hits++;
+    return true;
+}
+
+// Store a result, evicting the least recently used query if full
+void SearchCache::store(Field field, const std::string& term, const CachedResult& result, unsigned long generationSeen) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    // The catalog changed while this result was being computed
+    if (generationSeen != generation || capacity == 0) {
+        return;
+    }
+
+    std::string key = makeKey(field, term);
+    std::unordered_map<std::string, EntryList::iterator>::iterator found = lookupTable.find(key);
+    if (found != lookupTable.end()) {
+        // Another search got here first, just refresh its result
+        memoryBytes -= entrySize(*found->second);
+        found->second->result = result;
+        memoryBytes += entrySize(*found->second);
+        entries.splice(entries.begin(), entries, found->second);
+        return;
+    }
+
+    if (entries.size() >= capacity) {
+        eraseEntry(--entries.end());
+        evictions++;
+    }
+
+    Entry entry;
+    entry.field = field;
+    entry.term = term;
+    entry.result = result;
+    entries.push_front(entry);
+    lookupTable[key] = entries.begin();
+    memoryBytes += entrySize(entry);
+}
+
+// Only queries whose term occurs in the changed value can have a different answer
+// Pass both the old and the new value when a field is edited
+void SearchCache::invalidate(Field field, const std::string& value) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    generation++;
+
+    std::string normalized = normalize(value);
+    EntryList::iterator it = entries.begin();
+    while (it != entries.end()) {
+        EntryList::iterator current = it++;
+        if (current->field == field && normalized.find(current->term) != std::string::npos) {
+            eraseEntry(current);
+            invalidations++;
+        }
+    }
+}
+
+// Display cache statistics
+void SearchCache::displayStats() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    unsigned long lookups = hits + misses;
+    double hitRate = (lookups == 0) ? 0.0 : 100.0 * hits / lookups;
+
+    std::cout << "Search Cache: " << entries.size() << "/" << capacity << " queries, about " << memoryBytes << " bytes" << std::endl;
+    std::cout << "Cache Hits: " << hits << " / " << lookups << " (" << std::fixed << std::setprecision(1) << hitRate << "%)" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+    std::cout << "Evictions: " << evictions << ", Invalidations: " << invalidations << std::endl;
+}
@@ -0,0 +1,76 @@
+// SearchCache.h
+// Header file for the SearchCache class
+// Remembers recent search results so repeated queries skip the catalog scan
+
+#ifndef SEARCHCACHE_H
+#define SEARCHCACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+// One remembered search result
+// Positions are only a hint into the catalog - the ISBN is what counts
+struct CachedResult {
+    std::vector<std::string> isbns;
+    std::vector<size_t> positions;
+};
+
+class SearchCache {
+    public:
+        // Which book field a query searched
+        enum Field { TITLE, AUTHOR, GENRE };
+
+    private:
+        struct Entry {
+            Field field;
+            std::string term;       // normalized (lowercase) search term
+            CachedResult result;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        EntryList entries;          // most recently used at the front
+        std::unordered_map<std::string, EntryList::iterator> lookupTable;
+        size_t capacity;
+        mutable std::mutex cacheMutex;
+
+        // Bumped on every invalidation so results computed before it are not stored
+        unsigned long generation;
+
+        // Statistics
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long evictions;
+        unsigned long invalidations;
+        size_t memoryBytes;         // rough size of all cached entries
+
+        static std::string makeKey(Field field, const std::string& term);
+        static size_t entrySize(const Entry& entry);
+        void eraseEntry(EntryList::iterator it);
+
+    public:
+        // Constructor
+        SearchCache(size_t capacity = 64);
+
+        // Lowercase a term the same way the searches compare it
+        static std::string normalize(const std::string& text);
+
+        // Look up a query; fills result and returns true on a hit
+        // Generation is filled in either way and must be passed back to store()
+        bool lookup(Field field, const std::string& term, CachedResult& result, unsigned long& generationSeen);
+
+        // Remember a freshly computed result
+        // Ignored if anything was invalidated since generationSeen
+        void store(Field field, const std::string& term, const CachedResult& result, unsigned long generationSeen);
+
+        // Drop every query on this field that matches the given field value
+        void invalidate(Field field, const std::string& value);
+
+        // Display hit rate, size and eviction counts
+        void displayStats() const;
+};
+
+#endif
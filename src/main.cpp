@@ -15,6 +15,9 @@ void handleReturnBook(Library& lib);
 void handleSearchBooks(Library& lib);
 void handleUpdateCopies(Library& lib);
 void handleToggleBorrowStatus(Library& lib);
+void handleEditBook(Library& lib);
+void handleCirculationReport(Library& lib);
+void handleAutocomplete(Library& lib);
 void clearInputBuffer();
 
 int main() {
@@ -87,6 +90,15 @@ int main() {
             case 10:
                 myLibrary.displayLibraryInfo();
                 break;
+            case 11:
+                handleEditBook(myLibrary);
+                break;
+            case 12:
+                handleCirculationReport(myLibrary);
+                break;
+            case 13:
+                handleAutocomplete(myLibrary);
+                break;
             case 0:
                 std::cout << "Thank you for using the Library Management System!" << std::endl;
                 running = false;
@@ -112,6 +124,9 @@ void displayMenu() {
     std::cout << "8.  Update Book Copies" << std::endl;
     std::cout << "9.  Toggle Borrow Status" << std::endl;
     std::cout << "10. Display Library Statistics" << std::endl;
+    std::cout << "11. Edit Book Details" << std::endl;
+    std::cout << "12. Circulation Analytics" << std::endl;
+    std::cout << "13. Quick Title/Author Lookup" << std::endl;
     std::cout << "0.  Exit" << std::endl;
     std::cout << "===============================================" << std::endl;
 }
@@ -241,6 +256,47 @@ void handleToggleBorrowStatus(Library& lib) {
     lib.setBorrowStatus(isbn, status);
 }
 
+// Change title, author and genre of an existing book
+void handleEditBook(Library& lib) {
+    std::string isbn, title, author, genre;
+    
+    std::cout << "Enter ISBN: ";
+    std::getline(std::cin, isbn);
+    
+    std::cout << "Enter New Title: ";
+    std::getline(std::cin, title);
+    
+    std::cout << "Enter New Author: ";
+    std::getline(std::cin, author);
+    
+    std::cout << "Enter New Genre: ";
+    std::getline(std::cin, genre);
+    
+    lib.updateBookInfo(isbn, title, author, genre);
+}
+
+// Show the most borrowed titles, authors and genres
+void handleCirculationReport(Library& lib) {
+    int hours;
+    
+    std::cout << "Report on the last how many hours? ";
+    std::cin >> hours;
+    
+    clearInputBuffer();
+    
+    lib.displayCirculationReport(hours);
+}
+
+// Suggest titles and authors from the first few letters
+void handleAutocomplete(Library& lib) {
+    std::string prefix;
+    
+    std::cout << "Start typing a title or author: ";
+    std::getline(std::cin, prefix);
+    
+    lib.displaySuggestions(prefix);
+}
+
 // Clear any remaining characters in input buffer
 // Prevents issues with mixing getline and cin
 void clearInputBuffer() {